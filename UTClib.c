@@ -12,6 +12,21 @@
 
 static int findUTC_debug = DEBUG_OFF;  /* default is debug output is off */
 
+/* entry of a dtp_list_t, a list entry plus where each hit of its date was
+ * found.  Kept private so only post_insert ever creates or walks them.
+ */
+
+typedef struct DTP_ENTRY {
+    dtv_t             dtv;        /* list entry, must stay first */
+    unsigned char    *post;       /* delta encoded offsets of each hit */
+    size_t            post_len;   /* bytes used in post */
+    size_t            post_size;  /* bytes allocated for post */
+    long long         post_last;  /* offset of the last hit posted */
+} dtp_t;
+
+static int insert_entry(dtv_t **chk_list, char *chk_str, int posted,
+                        long long offset);
+
 /*-------------------------------------------------------------------------
  * Debugging function allows user to set a level of DEBUG information
  *    currently allows only OFF (default 0 value) or ON (anything else)
@@ -146,6 +161,15 @@ int valid_time(int format, int hour, int minute, int second)
  *                  for UTC is 4 character separated format is allowed
  */
 int format_match(char *dtstr, int format)
+{
+    return format_parse(dtstr, format, NULL);
+}
+
+/*-------------------------------------------------------------------------
+ * Parse for format as format_match does, and when the string is VALIDATED
+ *     and fields is not NULL fill in the parsed values of the date
+ */
+int format_parse(char *dtstr, int format, utcf_t *fields)
 {
     int  i;
     int  chkret = VALIDATED;
@@ -280,6 +304,18 @@ int format_match(char *dtstr, int format)
                     return INVALID_TMZ;
                 }
             }
+            if (fields != NULL)
+            {
+                fields->year     = chkyr;
+                fields->month    = chkmon;
+                fields->day      = chkday;
+                fields->hour     = chkhr;
+                fields->minute   = chkmin;
+                fields->second   = chksec;
+                fields->tzsign   = dtstr[19];
+                fields->tzhour   = chktzh;
+                fields->tzminute = chktzm;
+            }
             break;
         default:
             return INVALID_FORMAT; /* fail on unknown format check */
@@ -287,6 +323,58 @@ int format_match(char *dtstr, int format)
     return VALIDATED; /* check */
 }
 
+/*-------------------------------------------------------------------------
+ * Scan a buffer for UTC-8601 dates located anywhere in the text
+ *     The buffer does not need to be NULL terminated.  Each VALIDATED
+ *     date is passed to visit with its offset and length in the buffer,
+ *     and the scan continues after it unless visit returns non-zero.
+ *     Nothing is allocated, each candidate is checked in a local copy.
+ */
+int scan_utc(const char *buf, size_t len, utc_visit_t visit, void *ctx)
+{
+    char   chk_str[26];
+    size_t offset = 0;
+    size_t chk_len = 0;
+    int    chk_val = 0;
+    utcf_t fields;
+
+    if ((buf == NULL) || (visit == NULL))
+    {
+        return INVALID_REQUEST;
+    }
+    /* a date needs at least 20 characters */
+    while ((offset < len) && (len - offset >= 20))
+    {
+        /* skip the copy when the separators can not match */
+        if ((buf[offset + 4] != '-') || (buf[offset + 10] != 'T'))
+        {
+            offset++;
+            continue;
+        }
+        chk_len = len - offset;
+        if (chk_len > 25)
+        {
+            chk_len = 25;
+        }
+        memcpy(chk_str, buf + offset, chk_len);
+        chk_str[chk_len] = '\0';
+        chk_val = format_parse(chk_str, UTC8601, &fields);
+        if (chk_val != VALIDATED)
+        {
+            offset++;
+            continue;
+        }
+        /* format_parse trims a Z date so the length is now 20 or 25 */
+        chk_len = strlen(chk_str);
+        if (visit(ctx, offset, (int)chk_len, chk_val, &fields) != 0)
+        {
+            break;
+        }
+        offset += chk_len;
+    }
+    return VALIDATED;
+}
+
 
 /*-------------------------------------------------------------------------
  * Evaluate the given linked list for a string match
@@ -306,12 +394,109 @@ dtv_t *make_entry(char *chk_str)
     return blank;
 }
 
+/*-------------------------------------------------------------------------
+ * Allocate a list entry as make_entry does, with room for postings
+ */
+static dtv_t *make_post_entry(char *chk_str)
+{
+    dtp_t *blank = NULL;
+
+    blank = calloc( 1, sizeof( dtp_t ) );
+    if (blank == NULL)
+    {
+        return NULL;
+    }
+    strncpy(blank->dtv.dtstr, chk_str, 25);
+    blank->dtv.count = 1;
+    return &blank->dtv;
+}
+
+/*-------------------------------------------------------------------------
+ * Append a byte offset to the postings of an entry
+ *     The postings hold the distance from the previous offset of the
+ *     entry, 7 bits per byte with the high bit set on all but the last
+ *     byte, so nearby hits of a date take a single byte each.
+ *     The entry must have come from make_post_entry.
+ */
+static int post_offset(dtv_t *list_entry, long long offset)
+{
+    dtp_t             *entry = (dtp_t *)list_entry;
+    unsigned long long delta = 0;
+    unsigned char     *grown = NULL;
+    size_t             grow_size = 0;
+
+    /* make sure there is room for the largest encoded delta */
+    if (entry->post_size - entry->post_len < POST_MAX_BYTES)
+    {
+        grow_size = (entry->post_size == 0) ? POST_MIN_SIZE
+                                            : entry->post_size * 2;
+        grown = realloc(entry->post, grow_size);
+        if (grown == NULL)
+        {
+            return INVALID_MEMORY;
+        }
+        entry->post = grown;
+        entry->post_size = grow_size;
+    }
+    delta = (unsigned long long)(offset - entry->post_last);
+    while (delta >= 0x80)
+    {
+        entry->post[entry->post_len++] = (unsigned char)(delta | 0x80);
+        delta >>= 7;
+    }
+    entry->post[entry->post_len++] = (unsigned char)delta;
+    entry->post_last = offset;
+    return VALIDATED;
+}
+
+/*-------------------------------------------------------------------------
+ * Free every entry of a posting list along with its postings
+ */
+void post_free(dtp_list_t *list)
+{
+    dtv_t *walker = NULL;
+
+    while (list->head != NULL)
+    {
+        walker = list->head->next;
+        free(((dtp_t *)list->head)->post);
+        free(list->head);
+        list->head = walker;
+    }
+}
+
 /*-------------------------------------------------------------------------
  * Evaluate the given linked list for a string match
  *     If we find an existing match update the count of that date
  *     If we don't find a match allocate a new entry and insert it
  */
 int insert_or_match(dtv_t **chk_list, char *chk_str)
+{
+    return insert_entry(chk_list, chk_str, 0, 0);
+}
+
+/*-------------------------------------------------------------------------
+ * Evaluate the posting list for a string match as insert_or_match does,
+ *     also recording the file offset of the match in the postings of
+ *     the entry
+ */
+int post_insert(dtp_list_t *list, char *chk_str, long long offset)
+{
+    if ((list == NULL) || (offset < 0))
+    {
+        return INVALID_REQUEST;
+    }
+    return insert_entry(&list->head, chk_str, 1, offset);
+}
+
+/*-------------------------------------------------------------------------
+ * Evaluate the given linked list for a string match
+ *     When posted is set the list holds only dtp_t entries and the
+ *     offset is posted to the matched or new entry, otherwise it holds
+ *     only plain dtv_t entries.  Callers fix posted for the whole list.
+ */
+static int insert_entry(dtv_t **chk_list, char *chk_str, int posted,
+                        long long offset)
 {
     int  chk_val = 0;
     dtv_t *list_walker = *chk_list;
@@ -321,13 +506,14 @@ int insert_or_match(dtv_t **chk_list, char *chk_str)
     if (list_walker == NULL)
     {
         /* create the first entry in the list and set the new list head */
-        new_entry = make_entry(chk_str);
+        new_entry = posted ? make_post_entry(chk_str)
+                           : make_entry(chk_str);
         if (new_entry == NULL)
         {
             return INVALID_MEMORY;
         }
         *chk_list = new_entry;
-        return VALIDATED;
+        return posted ? post_offset(new_entry, offset) : VALIDATED;
     }
     while (list_walker != NULL)
     {
@@ -337,12 +523,13 @@ int insert_or_match(dtv_t **chk_list, char *chk_str)
         {
             /* Match Found! increase the count of the current entry */
             list_walker->count++;
-            return VALIDATED;
+            return posted ? post_offset(list_walker, offset) : VALIDATED;
         }
         if (chk_val < 0)
         {
             /* Value needs to be inserted prior to current entry */
-            new_entry = make_entry(chk_str);
+            new_entry = posted ? make_post_entry(chk_str)
+                               : make_entry(chk_str);
             if (new_entry == NULL)
             {
                 return INVALID_MEMORY;
@@ -360,7 +547,7 @@ int insert_or_match(dtv_t **chk_list, char *chk_str)
                 /* update the prev ptr to add new_entry */
                 new_entry->prev->next = new_entry;
             }
-            return VALIDATED;
+            return posted ? post_offset(new_entry, offset) : VALIDATED;
         }
         if (chk_val > 0)
         {
@@ -368,17 +555,158 @@ int insert_or_match(dtv_t **chk_list, char *chk_str)
             if (list_walker->next == NULL)
             {
                 /* append the new entry to the list end */
-                new_entry = make_entry(chk_str);
+                new_entry = posted ? make_post_entry(chk_str)
+                                   : make_entry(chk_str);
                 if (new_entry == NULL)
                 {
                     return INVALID_MEMORY;
                 }
                 list_walker->next = new_entry;
                 new_entry->prev = list_walker;
-                return VALIDATED;
+                return posted ? post_offset(new_entry, offset) : VALIDATED;
             }
             /* move to the next list entry */
             list_walker = list_walker->next;
         }
     }
 }
+
+/*-------------------------------------------------------------------------
+ * Write the occurrence index of the given linked list to an open file
+ *     The header is followed by one directory entry per date in list
+ *     (sorted) order and then the postings of every date.  The index is
+ *     written in host byte order so it can be mapped as is by lookups.
+ *     src_len and src_mtime tell lookups which version of the source
+ *     file the offsets belong to.
+ */
+int index_write(FILE *fptr, dtp_list_t *list, long long src_len,
+                long long src_mtime)
+{
+    utc_index_head_t  head;
+    utc_index_dir_t   dir;
+    dtv_t            *walker = NULL;
+    unsigned long long post_start = 0;
+
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, UTC_INDEX_MAGIC, sizeof(head.magic));
+    head.src_len = src_len;
+    head.src_mtime = src_mtime;
+    for (walker = list->head; walker != NULL; walker = walker->next)
+    {
+        head.entries++;
+    }
+    fwrite(&head, sizeof(head), 1, fptr);
+    post_start = sizeof(head) + head.entries * sizeof(dir);
+    for (walker = list->head; walker != NULL; walker = walker->next)
+    {
+        memset(&dir, 0, sizeof(dir));
+        strncpy(dir.dtstr, walker->dtstr, 25);
+        dir.hits = walker->count;
+        dir.post_start = post_start;
+        dir.post_len = ((dtp_t *)walker)->post_len;
+        fwrite(&dir, sizeof(dir), 1, fptr);
+        post_start += dir.post_len;
+    }
+    for (walker = list->head; walker != NULL; walker = walker->next)
+    {
+        if (((dtp_t *)walker)->post_len > 0)
+        {
+            fwrite(((dtp_t *)walker)->post, 1, ((dtp_t *)walker)->post_len,
+                   fptr);
+        }
+    }
+    if (ferror(fptr))
+    {
+        return INVALID_FILE;
+    }
+    return VALIDATED;
+}
+
+/*-------------------------------------------------------------------------
+ * Visit every recorded offset of the dates from through to in an index
+ *     The index is given as its complete image in memory (read or mapped)
+ *     A NULL to only looks up the from date itself.  Dates are compared
+ *     as strings, the same order the list and index are sorted in.
+ *     The scan stops early when visit returns non-zero.
+ */
+int index_lookup(const unsigned char *map, size_t len, char *from, char *to,
+                 idx_visit_t visit, void *ctx)
+{
+    const utc_index_head_t *head = (const utc_index_head_t *)map;
+    const utc_index_dir_t  *dir = NULL;
+    const unsigned char    *post = NULL;
+    unsigned long long      lo = 0;
+    unsigned long long      hi = 0;
+    unsigned long long      mid = 0;
+    unsigned long long      offset = 0;
+    unsigned long long      delta = 0;
+    size_t                  pos = 0;
+    int                     shift = 0;
+    unsigned char           byte = 0;
+
+    if ((map == NULL) || (from == NULL) || (visit == NULL))
+    {
+        return INVALID_REQUEST;
+    }
+    if ((len < sizeof(utc_index_head_t))
+    ||  (memcmp(head->magic, UTC_INDEX_MAGIC, sizeof(head->magic)) != 0)
+    ||  (head->entries > (len - sizeof(utc_index_head_t))
+                         / sizeof(utc_index_dir_t)))
+    {
+        return INVALID_FILE;
+    }
+    dir = (const utc_index_dir_t *)(map + sizeof(utc_index_head_t));
+    /* locate the first date that is not less than from */
+    hi = head->entries;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (strncmp(dir[mid].dtstr, from, 25) < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    for (; lo < head->entries; lo++)
+    {
+        if ((to == NULL) ? (strncmp(dir[lo].dtstr, from, 25) != 0)
+                         : (strncmp(dir[lo].dtstr, to, 25) > 0))
+        {
+            break;
+        }
+        if ((dir[lo].post_start > len)
+        ||  (dir[lo].post_len > len - dir[lo].post_start))
+        {
+            return INVALID_FILE;
+        }
+        post = map + dir[lo].post_start;
+        offset = 0;
+        pos = 0;
+        while (pos < dir[lo].post_len)
+        {
+            /* decode the next delta */
+            delta = 0;
+            shift = 0;
+            do
+            {
+                /* a delta cut short or longer than any offset is corrupt */
+                if ((pos >= dir[lo].post_len) || (shift >= 7 * POST_MAX_BYTES))
+                {
+                    return INVALID_FILE;
+                }
+                byte = post[pos++];
+                delta |= (unsigned long long)(byte & 0x7f) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            offset += delta;
+            if (visit(ctx, dir[lo].dtstr, offset) != 0)
+            {
+                return VALIDATED;
+            }
+        }
+    }
+    return VALIDATED;
+}
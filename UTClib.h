@@ -1,6 +1,9 @@
 #if !defined( FINDUTC_HEADER)
   #define FINDUTC_HEADER
 
+#include <stddef.h>
+#include <stdio.h>
+
 /* Set types and enums used for calls and return values */
 
 typedef enum {
@@ -14,7 +17,8 @@ typedef enum {
     INVALID_SECOND,
     INVALID_TMZ,
     INVALID_REQUEST,
-    INVALID_MEMORY
+    INVALID_MEMORY,
+    INVALID_FILE
 } code_t;
 
 typedef enum {
@@ -37,13 +41,73 @@ typedef struct DTV_ENTRY {
     struct DTV_ENTRY *prev;
 } dtv_t;
 
+/* list of dates that also records where each hit of a date was found,
+ * only post_insert adds entries so every one of them carries postings
+ */
+
+typedef struct DTP_LIST {
+    dtv_t *head;  /* sorted entries, walk them as a normal list */
+} dtp_list_t;
+
+typedef struct UTC_FIELDS {
+    int  year;
+    int  month;
+    int  day;
+    int  hour;
+    int  minute;
+    int  second;
+    char tzsign;    /* 'Z', '+' or '-' */
+    int  tzhour;    /* 0 when tzsign is 'Z' */
+    int  tzminute;  /* 0 when tzsign is 'Z' */
+} utcf_t;
+
+/* occurrence index file layout, directory entries follow the header
+ * and the postings of every date follow the directory
+ */
+
+#define UTC_INDEX_MAGIC "UTCIDX2"
+#define POST_MIN_SIZE   16  /* first allocation for postings of a date */
+#define POST_MAX_BYTES  10  /* longest encoded posting delta */
+
+typedef struct UTC_INDEX_HEAD {
+    char               magic[8];
+    unsigned long long entries;
+    long long          src_len;    /* length of the file indexed */
+    long long          src_mtime;  /* modify time of the file indexed */
+} utc_index_head_t;
+
+typedef struct UTC_INDEX_DIR {
+    char               dtstr[32];
+    unsigned long long hits;
+    unsigned long long post_start;  /* file offset of the postings */
+    unsigned long long post_len;    /* bytes of postings */
+} utc_index_dir_t;
+
+/* index_lookup callback, return non-zero to stop the lookup */
+
+typedef int (*idx_visit_t)(void *ctx, const char *dtstr,
+                           unsigned long long offset);
+
+/* scan_utc callback, return non-zero to stop the scan */
+
+typedef int (*utc_visit_t)(void *ctx, size_t offset, int length,
+                           code_t code, utcf_t *fields);
+
 /* function prototype declarations */
 
 int valid_date(int format, int year, int month, int day);
 int valid_time(int format, int hour, int minute, int second);
 int format_match(char *dtstr, int format);
+int format_parse(char *dtstr, int format, utcf_t *fields);
+int scan_utc(const char *buf, size_t len, utc_visit_t visit, void *ctx);
 dtv_t *make_entry(char *chk_str);
 int insert_or_match(dtv_t **chk_list, char *chk_str);
+int post_insert(dtp_list_t *list, char *chk_str, long long offset);
+void post_free(dtp_list_t *list);
+int index_write(FILE *fptr, dtp_list_t *list, long long src_len,
+                long long src_mtime);
+int index_lookup(const unsigned char *map, size_t len, char *from, char *to,
+                 idx_visit_t visit, void *ctx);
 
 /* setup a DEBUG output allowing us to turn on and off DEBUG from cmd line */
 
@@ -1,9 +1,20 @@
+/* Large file support, must be set before the system includes */
+
+#if !defined( _MSC_VER )
+  #define _FILE_OFFSET_BITS 64
+#endif
+
 /* System and standard includes */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 /* user specific includes */
 
@@ -13,6 +24,32 @@
 
 #define MAX_LINE_LEN 500
 #define MAX_FILE_LEN 512
+#define MAX_ARG_COUNT 19
+
+/* 64 bit file offsets so files past 2GB can be sampled on every platform */
+
+#if defined( _MSC_VER )
+  #define file_seek _fseeki64
+  #define file_tell _ftelli64
+#else
+  #define file_seek fseeko
+  #define file_tell ftello
+#endif
+
+typedef long long file_off_t;
+
+#define SAMPLE_BLOCK_LEN 65536 /* size of each block picked in sample mode */
+#define SAMPLE_Z_95      1.96  /* normal quantile for a 95% confidence interval */
+
+#define SPILL_CHECK_HITS 256   /* dates inserted between list size checks */
+#define SPILL_MAX_RUNS   64    /* run files kept before merging them to one */
+#define SPILL_OPEN_TRIES 100   /* names tried when creating a run file */
+
+/* a list node as the allocator hands it out, size header and rounding */
+#define SPILL_NODE_COST  ((sizeof(dtv_t) + sizeof(size_t) + 15) & ~(size_t)15)
+/* smallest limit holding the run file buffers plus a check of nodes */
+#define SPILL_MIN_LIMIT  ((long long)(SPILL_MAX_RUNS + 1) * BUFSIZ \
+                          + (long long)SPILL_CHECK_HITS * SPILL_NODE_COST)
 
 enum lcl_exit_codes_l {
     SUCCESS,
@@ -20,7 +57,10 @@ enum lcl_exit_codes_l {
     PARM_MISSING,
     PARM_UNKNOWN,
     FILE_NOT_FOUND,
-    MEM_ALLOC
+    MEM_ALLOC,
+    FILE_NOT_SEEKABLE,
+    INDEX_ERROR,
+    SPILL_ERROR
 };
 
 enum parse_formats_l {
@@ -32,12 +72,42 @@ enum parse_formats_l {
     FIELD_FORM   /* dates in fields (white space or comma separated) */
 };
 
+typedef struct SAMPLE_STATS {
+    file_off_t file_len;   /* total bytes in the file */
+    file_off_t blocks;     /* number of blocks the file divides into */
+    file_off_t picked;     /* number of blocks actually parsed */
+    file_off_t bytes_read; /* bytes read for the picked blocks */
+} sample_t;
+
+typedef struct SAMPLE_ENTRY {
+    dtv_t  dtv;    /* list entry, must stay first so the list holds dtv_t */
+    double sqsum;  /* sum of the squared per block counts */
+} smp_t;
+
+typedef struct SPILL_RECORD {
+    char  dtstr[26];
+    long  count;
+} spill_rec_t;
+
+typedef struct SPILL_STATE {
+    long long mem_limit;  /* bytes allowed for the list and run buffers */
+    long      hits;       /* dates inserted since the last size check */
+    int       run_count;  /* run files in use */
+    int       run_seq;    /* sequence number for the next run file name */
+    char      dir[MAX_FILE_LEN+1];  /* directory the run files go in */
+    FILE     *runs[SPILL_MAX_RUNS+1];
+    char      names[SPILL_MAX_RUNS+1][MAX_FILE_LEN+48];  /* runs left to remove */
+} spill_t;
+
 /*-------------------------------------------------
  * Usage:  a help/man page for the program
  */
 int usage( int val, char *name )
 {
     printf( "Usage: %s <-f {filename}> [-t {table|text}] [-verbose]\n", name );
+    printf( "          [-sample {fraction} [-seed {number}]]\n" );
+    printf( "          [-index {indexfile} [-find {date} [-to {date}]]]\n" );
+    printf( "          [-mem-limit {bytes}[K|M|G] [-spill-dir {directory}]]\n" );
     printf( "    {filename} - file to read and parse\n" );
     printf( "    table - DEFAULT setting.  Indicates the dates are 1\n" );
     printf( "            per line in file with no aditional text\n" );
@@ -45,6 +115,26 @@ int usage( int val, char *name )
     printf( "           (this evaluation will take longer)\n" );
     printf( "    -verbose - outputs additional text during run\n" );
     printf( "             (primarily for DEBUGGING)\n" );
+    printf( "    -sample - only parse a random {fraction} (0 - 1) of the\n" );
+    printf( "              %d byte blocks of the file and estimate the\n",
+            SAMPLE_BLOCK_LEN );
+    printf( "              counts with a 95%% confidence interval\n" );
+    printf( "    -seed - random seed for -sample so a run can be repeated\n" );
+    printf( "            (DEFAULT is the current time)\n" );
+    printf( "    -index - write the offset of every date located to\n" );
+    printf( "             {indexfile} along with the counts\n" );
+    printf( "    -find - do not parse, instead show each occurrence of\n" );
+    printf( "            {date} recorded in {indexfile}\n" );
+    printf( "    -to - with -find show every date from -find through {date}\n" );
+    printf( "    -mem-limit - keep the dates held in memory under {bytes}\n" );
+    printf( "                 by spilling sorted runs to temporary files\n" );
+    printf( "                 and merging them for the final counts\n" );
+    printf( "                 (counts the list entries with allocator\n" );
+    printf( "                 overhead and the run file buffers, at\n" );
+    printf( "                 least %lld bytes)\n", SPILL_MIN_LIMIT );
+    printf( "    -spill-dir - directory for the -mem-limit run files\n" );
+    printf( "                 (DEFAULT is TMPDIR, TEMP or TMP when set,\n" );
+    printf( "                 otherwise the current directory)\n" );
     printf( "  Exit values:\n" );
     printf( "    %d - parse of data for dates successful\n", SUCCESS );
     printf( "    %d - general parameter error\n", PARM_ERROR );
@@ -52,13 +142,17 @@ int usage( int val, char *name )
     printf( "    %d - unknown parameter given\n", PARM_UNKNOWN );
     printf( "    %d - source file not found\n", FILE_NOT_FOUND );
     printf( "    %d - memory allocation error during parse\n", MEM_ALLOC );
+    printf( "    %d - source file can not be sampled\n", FILE_NOT_SEEKABLE );
+    printf( "    %d - index file can not be read or written\n", INDEX_ERROR );
+    printf( "    %d - temporary run file can not be read or written\n",
+            SPILL_ERROR );
     exit( val );
 }
 
 /*-------------------------------------------------
- * cleanup:  free the allocated link list and exit with given code
+ * free_list:  free the allocated link list
  */
-int cleanup( int val, dtv_t *list_entry )
+void free_list( dtv_t *list_entry )
 {
     dtv_t * walker = NULL;
 
@@ -69,105 +163,265 @@ int cleanup( int val, dtv_t *list_entry )
         free( list_entry );
         list_entry = walker;
     }
+}
+
+/*-------------------------------------------------
+ * cleanup:  free the allocated link list and exit with given code
+ */
+int cleanup( int val, dtv_t *list_entry )
+{
+    free_list( list_entry );
     exit( val );
 }
 
 /*-------------------------------------------------
- * Arguments
- *   specify file to read
- *   indicating what kind of file check to perform
- *     1) Validate a flat file list of dates
- *     2) Read a file and locate dates in text
+ * merge_runs:  merge the sorted run files and the sorted list into one
+ *     sorted set of counts, either written to out as a new run or shown
+ *     when out is NULL.  Only the current record of each run is held.
  */
-int main( int argc, char **argv)
+int merge_runs( spill_t *spill, dtv_t *list, FILE *out )
 {
-    dtv_t *valid_list = NULL;
-    dtv_t *list_walker = NULL;
-    FILE  *fptr = NULL;
-    char   line[MAX_LINE_LEN+1];
-    char   clean_line[MAX_LINE_LEN+1];
-    char   filename[MAX_FILE_LEN+1];
-    int    chk_val = 0;
-    int    offset = 0;
-    int    loop_file = 1; /* default to on for file read */
-    int    loop_line = 0;
-    int    i = 0;
-    int    filename_arg_found = 0;
-    int    line_fill_amount = MAX_LINE_LEN;
-    int    full_line_read = 1;  /* start with a full read buffer for text mode */
-    int    line_read_initial = 0;  /* start with a full read buffer for text mode */
-    int    parse_form = 0;      /* default TABLE format */
+    spill_rec_t heads[SPILL_MAX_RUNS];
+    int         active[SPILL_MAX_RUNS];
+    spill_rec_t merged;
+    char       *low_str = NULL;
+    int         i = 0;
 
-    memset( line, '\0', sizeof(line) );
-    memset( filename, '\0', sizeof(filename) );
-    memset( clean_line, '\0', sizeof(clean_line) );
-    if ( (argc < 2) || (argc > 6) )
+    for (i=0; i<spill->run_count; i++)
     {
-        printf( "invalid number of arguments\n", argv[i] );
-        usage( PARM_ERROR, argv[0] );
+        rewind( spill->runs[i] );
+        active[i] = ( fread( &heads[i], sizeof(spill_rec_t), 1,
+                             spill->runs[i] ) == 1 );
     }
-    /* Start working through the parameters passed in */
-    for (i=1; i<argc; i++)
+    while ( 1 )
     {
-        if ( strcmp( argv[i], "-f" ) == 0 )
+        /* locate the lowest date at the head of the runs and list */
+        low_str = (list != NULL) ? list->dtstr : NULL;
+        for (i=0; i<spill->run_count; i++)
         {
-            /* make sure we have a filename argument */
-            if ( i+1 == argc )
+            if ( active[i]
+            &&   ( (low_str == NULL) || (strcmp( heads[i].dtstr, low_str ) < 0) ) )
             {
-                usage( PARM_MISSING, argv[0] );
+                low_str = heads[i].dtstr;
             }
-            i++; /*move to next argument */
-            strncpy( filename, argv[i], MAX_FILE_LEN );
-            filename_arg_found = 1;
         }
-        else if ( strcmp( argv[i], "-t" ) == 0 )
+        if ( low_str == NULL )
         {
-            /* make sure we have another argument */
-            if ( i+1 == argc )
-            {
-                usage( PARM_MISSING, argv[0] );
-            }
-            i++; /*move to next argument */
-            if ( stricmp( argv[i], "table" ) == 0 )
-            {
-                parse_form = TABLE_FORM;
-            }
-            else if ( stricmp( argv[i], "text" ) == 0 )
-            {
-                parse_form = TEXT_FORM;
-            }
-            else
+            break; /* everything is merged */
+        }
+        /* add up and move past every head holding that date */
+        memset( &merged, 0, sizeof(merged) );
+        strncpy( merged.dtstr, low_str, 25 );
+        if ( (list != NULL) && (strcmp( list->dtstr, merged.dtstr ) == 0) )
+        {
+            merged.count += list->count;
+            list = list->next;
+        }
+        for (i=0; i<spill->run_count; i++)
+        {
+            if ( active[i] && (strcmp( heads[i].dtstr, merged.dtstr ) == 0) )
             {
-                usage( PARM_ERROR, argv[0] );
+                merged.count += heads[i].count;
+                active[i] = ( fread( &heads[i], sizeof(spill_rec_t), 1,
+                                     spill->runs[i] ) == 1 );
             }
         }
-        else if ( stricmp( argv[i], "-verbose" ) == 0 )
+        if ( out == NULL )
         {
-            UTCLIB_DEBUG_SET( DEBUG_USR );
+            printf ( "  Date: %s  Found %ld times\n",
+                     merged.dtstr, merged.count );
         }
-        else if ( stricmp( argv[i], "-help" ) == 0 )
+        else if ( fwrite( &merged, sizeof(spill_rec_t), 1, out ) != 1 )
         {
-            usage( SUCCESS, argv[0] );
+            return SPILL_ERROR;
         }
-        else
+    }
+    for (i=0; i<spill->run_count; i++)
+    {
+        if ( ferror( spill->runs[i] ) )
         {
-            printf( "Unknown argument [%s]\n", argv[i] );
-            usage( PARM_UNKNOWN, argv[0] );
+            return SPILL_ERROR;
         }
     }
-    if ( !filename_arg_found )
+    /* flush the new run now, a later rewind would hide its write errors */
+    if ( ( out != NULL )
+    &&   ( ( fflush( out ) != 0 ) || ferror( out ) ) )
     {
-        /* unable to open parse file */
-        printf( "Required parameter <filename> missing!\n", filename );
-        usage( PARM_MISSING, argv[0] );
+        return SPILL_ERROR;
     }
-    fptr = fopen( filename, "r" );
-    if ( fptr == NULL )
+    return SUCCESS;
+}
+
+/*-------------------------------------------------
+ * close_run:  close a run file and remove it if that was not possible
+ *     while it was open
+ */
+void close_run( spill_t *spill, int slot )
+{
+    fclose( spill->runs[slot] );
+    spill->runs[slot] = NULL;
+    if ( spill->names[slot][0] != '\0' )
     {
-        /* unable to open parse file */
-        printf( "Unable to open file [%s]!\n", filename );
-        cleanup( FILE_NOT_FOUND, valid_list );
+        remove( spill->names[slot] );
+        spill->names[slot][0] = '\0';
+    }
+}
+
+/*-------------------------------------------------
+ * close_runs:  close (and so remove) all of the temporary run files
+ */
+void close_runs( spill_t *spill )
+{
+    int    i = 0;
+
+    for (i=0; i<spill->run_count; i++)
+    {
+        close_run( spill, i );
     }
+    spill->run_count = 0;
+}
+
+/*-------------------------------------------------
+ * open_run:  create a new run file in the spill directory as the given
+ *     slot.  The file is removed at once where an open file may be, so
+ *     nothing is left behind, otherwise its name is kept for close_run.
+ */
+int open_run( spill_t *spill, int slot )
+{
+    int    tries = 0;
+
+    spill->runs[slot] = NULL;
+    spill->names[slot][0] = '\0';
+    for (tries = 0; (spill->runs[slot] == NULL) && (tries < SPILL_OPEN_TRIES);
+         tries++)
+    {
+        sprintf( spill->names[slot], "%s/findUTC_%lx_%d.run", spill->dir,
+                 (unsigned long)time( NULL ), spill->run_seq++ );
+        /* x fails on a name already in use, so just try the next one */
+        spill->runs[slot] = fopen( spill->names[slot], "w+bx" );
+    }
+    if ( spill->runs[slot] == NULL )
+    {
+        spill->names[slot][0] = '\0';
+        return SPILL_ERROR;
+    }
+    UTCLIB_DEBUG("Debug: run file <%s>\n", spill->names[slot] );
+    if ( remove( spill->names[slot] ) == 0 )
+    {
+        spill->names[slot][0] = '\0';
+    }
+    return SUCCESS;
+}
+
+/*-------------------------------------------------
+ * spill_list:  write the sorted list to a new temporary run file and
+ *     free it.  When the run files are used up they are merged into one.
+ */
+int spill_list( spill_t *spill, dtv_t **valid_list )
+{
+    dtv_t       *walker = NULL;
+    FILE        *run = NULL;
+    spill_rec_t  rec;
+
+    if ( open_run( spill, spill->run_count ) != SUCCESS )
+    {
+        return SPILL_ERROR;
+    }
+    run = spill->runs[ spill->run_count ];
+    for (walker = *valid_list; walker != NULL; walker = walker->next)
+    {
+        memset( &rec, 0, sizeof(rec) );
+        strncpy( rec.dtstr, walker->dtstr, 25 );
+        rec.count = walker->count;
+        fwrite( &rec, sizeof(rec), 1, run );
+    }
+    /* flush first so a write error on the last records is seen too */
+    if ( ( fflush( run ) != 0 ) || ferror( run ) )
+    {
+        close_run( spill, spill->run_count );
+        return SPILL_ERROR;
+    }
+    UTCLIB_DEBUG("Debug: spilled run <%d>\n", spill->run_count );
+    free_list( *valid_list );
+    *valid_list = NULL;
+    spill->run_count++;
+    if ( spill->run_count == SPILL_MAX_RUNS )
+    {
+        /* merge the runs so we never hold too many files open,
+         * the merged run goes in the spare slot past the others
+         */
+        if ( open_run( spill, SPILL_MAX_RUNS ) != SUCCESS )
+        {
+            return SPILL_ERROR;
+        }
+        if ( merge_runs( spill, NULL, spill->runs[SPILL_MAX_RUNS] ) != SUCCESS )
+        {
+            close_run( spill, SPILL_MAX_RUNS );
+            return SPILL_ERROR;
+        }
+        close_runs( spill );
+        spill->runs[0] = spill->runs[SPILL_MAX_RUNS];
+        strcpy( spill->names[0], spill->names[SPILL_MAX_RUNS] );
+        spill->runs[SPILL_MAX_RUNS] = NULL;
+        spill->names[SPILL_MAX_RUNS][0] = '\0';
+        spill->run_count = 1;
+    }
+    return SUCCESS;
+}
+
+/*-------------------------------------------------
+ * spill_check:  every SPILL_CHECK_HITS dates inserted measure the list
+ *     and spill it once it reaches the memory limit
+ *     Each node is counted as the allocator hands it out and each open
+ *     run file as a stdio buffer, both close estimates of the real use
+ */
+int spill_check( spill_t *spill, dtv_t **valid_list )
+{
+    dtv_t *walker = NULL;
+    long long mem_used = 0;
+
+    if ( ++spill->hits < SPILL_CHECK_HITS )
+    {
+        return SUCCESS;
+    }
+    spill->hits = 0;
+    mem_used = (long long)spill->run_count * BUFSIZ;
+    for (walker = *valid_list; walker != NULL; walker = walker->next)
+    {
+        mem_used += SPILL_NODE_COST;
+    }
+    if ( mem_used < spill->mem_limit )
+    {
+        return SUCCESS;
+    }
+    return spill_list( spill, valid_list );
+}
+
+/*-------------------------------------------------
+ * parse_file:  read the open file from its current position and add
+ *     every date located to the valid list
+ *     A read_limit of 0 or more stops the read at the first line that
+ *     starts at or after that file position, otherwise read to the end
+ *     When posts is not NULL every date goes there with its file offset
+ *     instead of to the valid list
+ *     When spill is not NULL the list is kept under its memory limit
+ */
+int parse_file( FILE *fptr, int parse_form, dtv_t **valid_list,
+                file_off_t read_limit, dtp_list_t *posts, spill_t *spill )
+{
+    char   line[MAX_LINE_LEN+1];
+    char   clean_line[MAX_LINE_LEN+1];
+    int    chk_val = 0;
+    int    offset = 0;
+    int    loop_file = 1; /* default to on for file read */
+    int    loop_line = 0;
+    int    line_fill_amount = MAX_LINE_LEN;
+    int    full_line_read = 1;  /* start with a full read buffer for text mode */
+    int    line_read_initial = 0;  /* start with a full read buffer for text mode */
+    file_off_t line_pos = 0;    /* file offset of the start of line */
+
+    memset( line, '\0', sizeof(line) );
+    memset( clean_line, '\0', sizeof(clean_line) );
     /* our first read should be the maximum */
     full_line_read = 1; /* having read nothing yet, consider the 'Previous' line a full read */
     while ( loop_file )
@@ -175,8 +429,23 @@ int main( int argc, char **argv)
         line_read_initial = 0;
         if ( full_line_read == 1 )
         {
+            /* a new line is starting, is it still within our limit? */
+            if ( (read_limit >= 0) && (file_tell(fptr) >= read_limit) )
+            {
+                loop_file = 0;
+                continue;
+            }
             line_fill_amount = MAX_LINE_LEN;
             line_read_initial = 1;
+            if ( posts != NULL )
+            {
+                line_pos = file_tell( fptr );
+                if ( line_pos < 0 )
+                {
+                    printf( "Unable to locate file position!\n" );
+                    return FILE_NOT_SEEKABLE;
+                }
+            }
         }
         if ( fgets(line+(MAX_LINE_LEN-line_fill_amount), line_fill_amount, fptr) == NULL )
         {
@@ -195,6 +464,11 @@ int main( int argc, char **argv)
         if ( line[ chk_val ] == '\n' )
         {
             line[ chk_val ] = '\0'; /* remove EOL */
+            /* the file is read in binary so remove a DOS EOL as well */
+            if ( (chk_val > 0) && (line[ chk_val - 1 ] == '\r') )
+            {
+                line[ chk_val - 1 ] = '\0';
+            }
             full_line_read = 1;     /* make sure we know this line ended */
         }
         else
@@ -217,14 +491,29 @@ int main( int argc, char **argv)
                 {
                     UTCLIB_DEBUG("Debug: VALIDATED <%s>\n", line );
                     /* text read was valid */
-                    chk_val = insert_or_match( &valid_list, line );
+                    if ( posts != NULL )
+                    {
+                        chk_val = post_insert( posts, line, line_pos );
+                    }
+                    else
+                    {
+                        chk_val = insert_or_match( valid_list, line );
+                    }
                     if ( chk_val != VALIDATED )
                     {
                         /* A memory issue occured in creating our list */
                         printf( "Memory allocation error!\n" );
-                        cleanup( MEM_ALLOC, valid_list );
+                        return MEM_ALLOC;
                     }
                     UTCLIB_DEBUG("Debug: Inserted <%s>\n", line );
+                    if ( spill != NULL )
+                    {
+                        chk_val = spill_check( spill, valid_list );
+                        if ( chk_val != SUCCESS )
+                        {
+                            return chk_val;
+                        }
+                    }
                 }
                 else
                 {
@@ -246,12 +535,28 @@ int main( int argc, char **argv)
                     if ( chk_val == VALIDATED )
                     {
                         /* text read was valid */
-                        chk_val = insert_or_match( &valid_list, clean_line );
+                        if ( posts != NULL )
+                        {
+                            chk_val = post_insert( posts, clean_line,
+                                                   line_pos + offset );
+                        }
+                        else
+                        {
+                            chk_val = insert_or_match( valid_list, clean_line );
+                        }
                         if ( chk_val != VALIDATED )
                         {
                             /* A memory issue occured in creating our list */
                             printf( "Memory allocation error!\n" );
-                            cleanup( MEM_ALLOC, valid_list );
+                            return MEM_ALLOC;
+                        }
+                        if ( spill != NULL )
+                        {
+                            chk_val = spill_check( spill, valid_list );
+                            if ( chk_val != SUCCESS )
+                            {
+                                return chk_val;
+                            }
                         }
                         /* move the minimum size and restart parse */
                         offset += 20;
@@ -284,15 +589,681 @@ int main( int argc, char **argv)
                     memset( line, '\0', sizeof(line) );
                     strncpy( line, clean_line, sizeof(line) );
                     line_fill_amount = MAX_LINE_LEN - strlen(line);
+                    line_pos += offset;
                 }
                 break;
             default:
                 break;
         }
     }
+    return SUCCESS;
+}
+
+/*-------------------------------------------------
+ * sample_rand:  splitmix64 generator giving a uniform value in [0, 1)
+ *     with 53 bits of resolution whatever RAND_MAX the library has
+ */
+double sample_rand( unsigned long long *state )
+{
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/*-------------------------------------------------
+ * merge_block:  move the entries of a sorted block list into the sorted
+ *     total list, adding the counts of matching dates and keeping the
+ *     sum of the squared block counts for the sample estimate
+ *     The total list is made of smp_t entries, the block list is freed
+ */
+int merge_block( dtv_t **total_list, dtv_t *block_list )
+{
+    dtv_t *walker = *total_list;
+    dtv_t *prev_entry = NULL;
+    dtv_t *next_block = NULL;
+    smp_t *new_entry = NULL;
+
+    while (block_list != NULL)
+    {
+        next_block = block_list->next;
+        /* both lists are sorted so the walker never needs to back up */
+        while ( (walker != NULL)
+        &&      (strcmp( walker->dtstr, block_list->dtstr ) < 0) )
+        {
+            prev_entry = walker;
+            walker = walker->next;
+        }
+        if ( (walker != NULL)
+        &&   (strcmp( walker->dtstr, block_list->dtstr ) == 0) )
+        {
+            /* Match Found! add the block count to the total */
+            walker->count += block_list->count;
+            ((smp_t *)walker)->sqsum += (double)block_list->count
+                                      * block_list->count;
+        }
+        else
+        {
+            /* insert a new total entry prior to the walker */
+            new_entry = calloc( 1, sizeof( smp_t ) );
+            if (new_entry == NULL)
+            {
+                free_list( block_list );
+                return MEM_ALLOC;
+            }
+            strncpy( new_entry->dtv.dtstr, block_list->dtstr, 25 );
+            new_entry->dtv.count = block_list->count;
+            new_entry->sqsum = (double)block_list->count * block_list->count;
+            new_entry->dtv.prev = prev_entry;
+            new_entry->dtv.next = walker;
+            if (prev_entry == NULL)
+            {
+                *total_list = &new_entry->dtv;
+            }
+            else
+            {
+                prev_entry->next = &new_entry->dtv;
+            }
+            if (walker != NULL)
+            {
+                walker->prev = &new_entry->dtv;
+            }
+            prev_entry = &new_entry->dtv;
+        }
+        free( block_list );
+        block_list = next_block;
+    }
+    return SUCCESS;
+}
+
+/*-------------------------------------------------
+ * sample_file:  parse a random subset of the blocks of the file
+ *     Each SAMPLE_BLOCK_LEN block is picked on its own with the fraction
+ *     as its chance.  A line belongs to the block it starts in, so a
+ *     picked block skips the partial line it begins with and reads past
+ *     its end to finish its last line.  When the previous picked block
+ *     already read into this one, carry on from where it stopped.
+ */
+int sample_file( FILE *fptr, int parse_form, dtv_t **valid_list,
+                 double fraction, unsigned long long seed, sample_t *stats )
+{
+    dtv_t     *block_list = NULL;
+    char       skip[MAX_LINE_LEN+1];
+    file_off_t block = 0;
+    file_off_t start = 0;
+    file_off_t seek_pos = 0;
+    file_off_t last_end = -1;  /* where the last picked block stopped */
+    int        chk_val = SUCCESS;
+
+    memset( stats, 0, sizeof(sample_t) );
+    if ( file_seek( fptr, 0, SEEK_END ) != 0 )
+    {
+        return FILE_NOT_SEEKABLE;
+    }
+    stats->file_len = file_tell( fptr );
+    if ( stats->file_len < 0 )
+    {
+        return FILE_NOT_SEEKABLE;
+    }
+    stats->blocks = (stats->file_len + SAMPLE_BLOCK_LEN - 1) / SAMPLE_BLOCK_LEN;
+    for (block = 0; block < stats->blocks; block++)
+    {
+        /* draw for every block, so the seed alone decides the picks */
+        if ( sample_rand( &seed ) >= fraction )
+        {
+            continue;
+        }
+        start = block * SAMPLE_BLOCK_LEN;
+        if ( last_end >= start )
+        {
+            /* the last block stopped at the first line starting here */
+            seek_pos = last_end;
+        }
+        else if ( start == 0 )
+        {
+            seek_pos = 0;
+        }
+        else
+        {
+            /* back up 1 character so a line starting right on the
+             * block boundary is not skipped as a partial line
+             */
+            seek_pos = start - 1;
+        }
+        if ( file_seek( fptr, seek_pos, SEEK_SET ) != 0 )
+        {
+            return FILE_NOT_SEEKABLE;
+        }
+        if ( seek_pos == start - 1 )
+        {
+            while ( ( fgets( skip, sizeof(skip), fptr ) != NULL )
+            &&      ( skip[ strlen(skip) - 1 ] != '\n' ) )
+            {
+                /* keep reading to the end of the partial line */
+            }
+        }
+        UTCLIB_DEBUG("Debug: sampling block <%lld> at <%lld>\n", block, start );
+        block_list = NULL;
+        chk_val = parse_file( fptr, parse_form, &block_list,
+                              start + SAMPLE_BLOCK_LEN, NULL, NULL );
+        last_end = file_tell( fptr );
+        stats->bytes_read += last_end - seek_pos;
+        stats->picked++;
+        if ( chk_val != SUCCESS )
+        {
+            free_list( block_list );
+            return chk_val;
+        }
+        chk_val = merge_block( valid_list, block_list );
+        if ( chk_val != SUCCESS )
+        {
+            printf( "Memory allocation error!\n" );
+            return chk_val;
+        }
+    }
+    return SUCCESS;
+}
+
+/*-------------------------------------------------
+ * show_hit:  index lookup callback, seek to the offset of the date and
+ *     show the rest of the line it is on
+ */
+int show_hit( void *ctx, const char *dtstr, unsigned long long offset )
+{
+    FILE  *fptr = (FILE *)ctx;
+    char   line[MAX_LINE_LEN+1];
+    int    chk_val = 0;
+
+    memset( line, '\0', sizeof(line) );
+    if ( ( file_seek( fptr, (file_off_t)offset, SEEK_SET ) != 0 )
+    ||   ( fgets( line, sizeof(line), fptr ) == NULL ) )
+    {
+        printf( "  Date: %s  Offset %llu unreadable!\n", dtstr, offset );
+        return 0;
+    }
+    chk_val = strlen(line) - 1;
+    if ( line[ chk_val ] == '\n' )
+    {
+        line[ chk_val ] = '\0'; /* remove EOL */
+        if ( (chk_val > 0) && (line[ chk_val - 1 ] == '\r') )
+        {
+            line[ chk_val - 1 ] = '\0';
+        }
+    }
+    printf( "  Date: %s  Offset %llu <%s>\n", dtstr, offset, line );
+    return 0;
+}
+
+/*-------------------------------------------------
+ * source_stamp:  get the length and modify time of the open source file
+ *     so an index can be matched with the file it was built from
+ *     The file is left at its start, a pipe is not seekable and fails
+ */
+int source_stamp( FILE *fptr, char *filename, long long *src_len,
+                  long long *src_mtime )
+{
+    struct stat file_stat;
+
+    if ( file_seek( fptr, 0, SEEK_END ) != 0 )
+    {
+        return FILE_NOT_SEEKABLE;
+    }
+    *src_len = file_tell( fptr );
+    /* go back to the start, ready for a parse of the file */
+    if ( ( *src_len < 0 ) || ( file_seek( fptr, 0, SEEK_SET ) != 0 ) )
+    {
+        return FILE_NOT_SEEKABLE;
+    }
+    *src_mtime = 0; /* the length alone is checked without a modify time */
+    if ( stat( filename, &file_stat ) == 0 )
+    {
+        *src_mtime = (long long)file_stat.st_mtime;
+    }
+    return SUCCESS;
+}
+
+/*-------------------------------------------------
+ * find_dates:  load the index file and show every recorded occurrence
+ *     of the dates from through to (or just from when to is NULL)
+ *     The index must have been built from this version of the file
+ */
+int find_dates( FILE *fptr, char *filename, char *index_name,
+                char *from, char *to )
+{
+    FILE             *iptr = NULL;
+    unsigned char    *map = NULL;
+    utc_index_head_t *head = NULL;
+    file_off_t        map_len = 0;
+    long long         src_len = 0;
+    long long         src_mtime = 0;
+    int               chk_val = VALIDATED;
+
+    if ( source_stamp( fptr, filename, &src_len, &src_mtime ) != SUCCESS )
+    {
+        printf( "Unable to read file [%s]!\n", filename );
+        return FILE_NOT_SEEKABLE;
+    }
+    iptr = fopen( index_name, "rb" );
+    if ( iptr == NULL )
+    {
+        printf( "Unable to open index [%s]!\n", index_name );
+        return INDEX_ERROR;
+    }
+    if ( ( file_seek( iptr, 0, SEEK_END ) != 0 )
+    ||   ( (map_len = file_tell( iptr )) <= 0 )
+    ||   ( (unsigned long long)map_len > (size_t)-1 ) )
+    {
+        printf( "Unable to read index [%s]!\n", index_name );
+        fclose( iptr );
+        return INDEX_ERROR;
+    }
+    map = malloc( (size_t)map_len );
+    if ( map == NULL )
+    {
+        printf( "Memory allocation error!\n" );
+        fclose( iptr );
+        return MEM_ALLOC;
+    }
+    rewind( iptr );
+    if ( fread( map, 1, (size_t)map_len, iptr ) != (size_t)map_len )
+    {
+        chk_val = INVALID_FILE;
+    }
+    fclose( iptr );
+    head = (utc_index_head_t *)map;
+    if ( ( chk_val == VALIDATED )
+    &&   ( (size_t)map_len >= sizeof(utc_index_head_t) )
+    &&   ( (head->src_len != src_len) || (head->src_mtime != src_mtime) ) )
+    {
+        printf( "Index [%s] was not built from this version of [%s]!\n",
+                index_name, filename );
+        free( map );
+        return INDEX_ERROR;
+    }
+    if ( chk_val == VALIDATED )
+    {
+        printf( "The follwing occurrences were located in the file:\n" );
+        chk_val = index_lookup( map, (size_t)map_len, from, to,
+                                show_hit, fptr );
+    }
+    free( map );
+    if ( chk_val != VALIDATED )
+    {
+        printf( "Invalid index [%s]!\n", index_name );
+        return INDEX_ERROR;
+    }
+    return SUCCESS;
+}
+
+/*-------------------------------------------------
+ * Arguments
+ *   specify file to read
+ *   indicating what kind of file check to perform
+ *     1) Validate a flat file list of dates
+ *     2) Read a file and locate dates in text
+ */
+int main( int argc, char **argv)
+{
+    dtv_t *valid_list = NULL;
+    dtv_t *list_walker = NULL;
+    FILE  *fptr = NULL;
+    char   filename[MAX_FILE_LEN+1];
+    char   index_name[MAX_FILE_LEN+1];
+    char  *num_end = NULL;
+    char  *env_dir = NULL;
+    char  *find_from = NULL;
+    char  *find_to = NULL;
+    int    chk_val = 0;
+    int    i = 0;
+    int    filename_arg_found = 0;
+    int    parse_form = 0;      /* default TABLE format */
+    int    seed_arg_found = 0;
+    double sample_fraction = 0; /* default read the whole file */
+    double estimate = 0;
+    double spread = 0;
+    unsigned long long sample_seed = 0;
+    long long mem_scale = 1;
+    long long src_len = 0;
+    dtp_list_t posts;
+    long long src_mtime = 0;
+    sample_t sample_stats;
+    spill_t  spill;
+
+    memset( filename, '\0', sizeof(filename) );
+    memset( index_name, '\0', sizeof(index_name) );
+    memset( &sample_stats, 0, sizeof(sample_stats) );
+    memset( &spill, 0, sizeof(spill) );
+    memset( &posts, 0, sizeof(posts) );
+    if ( (argc < 2) || (argc > MAX_ARG_COUNT) )
+    {
+        printf( "invalid number of arguments\n", argv[i] );
+        usage( PARM_ERROR, argv[0] );
+    }
+    /* Start working through the parameters passed in */
+    for (i=1; i<argc; i++)
+    {
+        if ( strcmp( argv[i], "-f" ) == 0 )
+        {
+            /* make sure we have a filename argument */
+            if ( i+1 == argc )
+            {
+                usage( PARM_MISSING, argv[0] );
+            }
+            i++; /*move to next argument */
+            strncpy( filename, argv[i], MAX_FILE_LEN );
+            filename_arg_found = 1;
+        }
+        else if ( strcmp( argv[i], "-t" ) == 0 )
+        {
+            /* make sure we have another argument */
+            if ( i+1 == argc )
+            {
+                usage( PARM_MISSING, argv[0] );
+            }
+            i++; /*move to next argument */
+            if ( stricmp( argv[i], "table" ) == 0 )
+            {
+                parse_form = TABLE_FORM;
+            }
+            else if ( stricmp( argv[i], "text" ) == 0 )
+            {
+                parse_form = TEXT_FORM;
+            }
+            else
+            {
+                usage( PARM_ERROR, argv[0] );
+            }
+        }
+        else if ( stricmp( argv[i], "-sample" ) == 0 )
+        {
+            /* make sure we have a fraction argument */
+            if ( i+1 == argc )
+            {
+                usage( PARM_MISSING, argv[0] );
+            }
+            i++; /*move to next argument */
+            sample_fraction = strtod( argv[i], &num_end );
+            if ( (*num_end != '\0')
+            ||   !( (sample_fraction > 0) && (sample_fraction <= 1) ) )
+            {
+                printf( "Invalid sample fraction [%s]\n", argv[i] );
+                usage( PARM_ERROR, argv[0] );
+            }
+        }
+        else if ( stricmp( argv[i], "-seed" ) == 0 )
+        {
+            /* make sure we have a seed argument */
+            if ( i+1 == argc )
+            {
+                usage( PARM_MISSING, argv[0] );
+            }
+            i++; /*move to next argument */
+            sample_seed = strtoull( argv[i], &num_end, 10 );
+            if ( *num_end != '\0' )
+            {
+                printf( "Invalid seed [%s]\n", argv[i] );
+                usage( PARM_ERROR, argv[0] );
+            }
+            seed_arg_found = 1;
+        }
+        else if ( stricmp( argv[i], "-index" ) == 0 )
+        {
+            /* make sure we have an index filename argument */
+            if ( i+1 == argc )
+            {
+                usage( PARM_MISSING, argv[0] );
+            }
+            i++; /*move to next argument */
+            strncpy( index_name, argv[i], MAX_FILE_LEN );
+        }
+        else if ( stricmp( argv[i], "-find" ) == 0 )
+        {
+            /* make sure we have a date argument */
+            if ( i+1 == argc )
+            {
+                usage( PARM_MISSING, argv[0] );
+            }
+            i++; /*move to next argument */
+            find_from = argv[i];
+        }
+        else if ( stricmp( argv[i], "-to" ) == 0 )
+        {
+            /* make sure we have a date argument */
+            if ( i+1 == argc )
+            {
+                usage( PARM_MISSING, argv[0] );
+            }
+            i++; /*move to next argument */
+            find_to = argv[i];
+        }
+        else if ( stricmp( argv[i], "-mem-limit" ) == 0 )
+        {
+            /* make sure we have a size argument */
+            if ( i+1 == argc )
+            {
+                usage( PARM_MISSING, argv[0] );
+            }
+            i++; /*move to next argument */
+            spill.mem_limit = strtoll( argv[i], &num_end, 10 );
+            mem_scale = 1;
+            switch ( toupper( *num_end ) )
+            {
+                case 'G':
+                    mem_scale *= 1024;
+                    /* fall through */
+                case 'M':
+                    mem_scale *= 1024;
+                    /* fall through */
+                case 'K':
+                    mem_scale *= 1024;
+                    num_end++;
+                    break;
+                default:
+                    break;
+            }
+            /* make sure the scaled limit still fits */
+            if ( (*num_end != '\0') || (spill.mem_limit <= 0)
+            ||   (spill.mem_limit > LLONG_MAX / mem_scale)
+            ||   (spill.mem_limit * mem_scale < SPILL_MIN_LIMIT) )
+            {
+                printf( "Invalid memory limit [%s]\n", argv[i] );
+                usage( PARM_ERROR, argv[0] );
+            }
+            spill.mem_limit *= mem_scale;
+        }
+        else if ( stricmp( argv[i], "-spill-dir" ) == 0 )
+        {
+            /* make sure we have a directory argument */
+            if ( i+1 == argc )
+            {
+                usage( PARM_MISSING, argv[0] );
+            }
+            i++; /*move to next argument */
+            strncpy( spill.dir, argv[i], MAX_FILE_LEN );
+        }
+        else if ( stricmp( argv[i], "-verbose" ) == 0 )
+        {
+            UTCLIB_DEBUG_SET( DEBUG_USR );
+        }
+        else if ( stricmp( argv[i], "-help" ) == 0 )
+        {
+            usage( SUCCESS, argv[0] );
+        }
+        else
+        {
+            printf( "Unknown argument [%s]\n", argv[i] );
+            usage( PARM_UNKNOWN, argv[0] );
+        }
+    }
+    if ( !filename_arg_found )
+    {
+        /* unable to open parse file */
+        printf( "Required parameter <filename> missing!\n", filename );
+        usage( PARM_MISSING, argv[0] );
+    }
+    if ( seed_arg_found && (sample_fraction == 0) )
+    {
+        printf( "Parameter -seed requires -sample!\n" );
+        usage( PARM_ERROR, argv[0] );
+    }
+    if ( (index_name[0] != '\0') && (sample_fraction > 0) )
+    {
+        printf( "Parameter -index can not be used with -sample!\n" );
+        usage( PARM_ERROR, argv[0] );
+    }
+    if ( (spill.dir[0] != '\0') && (spill.mem_limit == 0) )
+    {
+        printf( "Parameter -spill-dir requires -mem-limit!\n" );
+        usage( PARM_ERROR, argv[0] );
+    }
+    if ( (spill.mem_limit > 0) && (spill.dir[0] == '\0') )
+    {
+        /* use the usual temporary directory of the system */
+        if ( (env_dir = getenv( "TMPDIR" )) != NULL )
+        {
+            strncpy( spill.dir, env_dir, MAX_FILE_LEN );
+        }
+        else if ( (env_dir = getenv( "TEMP" )) != NULL )
+        {
+            strncpy( spill.dir, env_dir, MAX_FILE_LEN );
+        }
+        else if ( (env_dir = getenv( "TMP" )) != NULL )
+        {
+            strncpy( spill.dir, env_dir, MAX_FILE_LEN );
+        }
+        else
+        {
+            strncpy( spill.dir, ".", MAX_FILE_LEN );
+        }
+    }
+    if ( (spill.mem_limit > 0)
+    &&   ( (index_name[0] != '\0') || (sample_fraction > 0) ) )
+    {
+        printf( "Parameter -mem-limit can not be used with -index or -sample!\n" );
+        usage( PARM_ERROR, argv[0] );
+    }
+    if ( ( (find_from != NULL) && (index_name[0] == '\0') )
+    ||   ( (find_to != NULL) && (find_from == NULL) ) )
+    {
+        printf( "Parameter -find requires -index and -to requires -find!\n" );
+        usage( PARM_ERROR, argv[0] );
+    }
+    /* binary so sampled and indexed offsets are plain byte offsets */
+    fptr = fopen( filename, "rb" );
+    if ( fptr == NULL )
+    {
+        /* unable to open parse file */
+        printf( "Unable to open file [%s]!\n", filename );
+        cleanup( FILE_NOT_FOUND, valid_list );
+    }
+    if ( find_from != NULL )
+    {
+        /* look up the recorded offsets instead of parsing */
+        chk_val = find_dates( fptr, filename, index_name, find_from, find_to );
+        fclose( fptr );
+        cleanup( chk_val, valid_list );
+    }
+    if ( sample_fraction > 0 )
+    {
+        if ( !seed_arg_found )
+        {
+            sample_seed = (unsigned long long)time( NULL );
+        }
+        chk_val = sample_file( fptr, parse_form, &valid_list,
+                               sample_fraction, sample_seed, &sample_stats );
+        if ( chk_val == FILE_NOT_SEEKABLE )
+        {
+            printf( "Unable to sample file [%s]!\n", filename );
+        }
+    }
+    else
+    {
+        /* offsets are only worth recording when the file can be seeked */
+        if ( index_name[0] != '\0' )
+        {
+            chk_val = source_stamp( fptr, filename, &src_len, &src_mtime );
+            if ( chk_val != SUCCESS )
+            {
+                printf( "Unable to index file [%s]!\n", filename );
+                fclose( fptr );
+                cleanup( chk_val, valid_list );
+            }
+        }
+        chk_val = parse_file( fptr, parse_form, &valid_list, -1L,
+                              (index_name[0] != '\0') ? &posts : NULL,
+                              (spill.mem_limit > 0) ? &spill : NULL );
+    }
     fclose( fptr );
     fptr  = NULL;
-    list_walker = valid_list;
+    if ( chk_val != SUCCESS )
+    {
+        post_free( &posts );
+        if ( chk_val == SPILL_ERROR )
+        {
+            printf( "Unable to write temporary run file!\n" );
+        }
+        close_runs( &spill );
+        cleanup( chk_val, valid_list );
+    }
+    if ( spill.run_count > 0 )
+    {
+        /* the counts are split between the runs and the list */
+        printf( "The follwing Valid dates were located in the file:\n" );
+        chk_val = merge_runs( &spill, valid_list, NULL );
+        if ( chk_val != SUCCESS )
+        {
+            printf( "Unable to read temporary run file!\n" );
+        }
+        close_runs( &spill );
+        cleanup( chk_val, valid_list );
+    }
+    if ( index_name[0] != '\0' )
+    {
+        fptr = fopen( index_name, "wb" );
+        if ( ( fptr == NULL )
+        ||   ( index_write( fptr, &posts, src_len, src_mtime ) != VALIDATED )
+        ||   ( fclose( fptr ) != 0 ) )
+        {
+            printf( "Unable to write index [%s]!\n", index_name );
+            post_free( &posts );
+            cleanup( INDEX_ERROR, valid_list );
+        }
+        fptr = NULL;
+    }
+    /* with -index the counts were kept in the posting list */
+    list_walker = (index_name[0] != '\0') ? posts.head : valid_list;
+    if ( sample_fraction > 0 )
+    {
+        /* each block was picked with the same chance, so scale the counts
+         * by it and estimate the variance from the per block counts
+         */
+        printf( "Sampled %lld of %lld blocks with seed %llu\n",
+                sample_stats.picked, sample_stats.blocks, sample_seed );
+        printf( "Read %lld of %lld bytes (%.2f%%)\n",
+                sample_stats.bytes_read, sample_stats.file_len,
+                (sample_stats.file_len > 0)
+                    ? (100.0 * sample_stats.bytes_read) / sample_stats.file_len
+                    : 0.0 );
+        printf( "The follwing Valid dates were estimated in the file:\n" );
+        while ( list_walker != NULL )
+        {
+            estimate = list_walker->count / sample_fraction;
+            spread = SAMPLE_Z_95
+                   * sqrt( (1 - sample_fraction)
+                           * ((smp_t *)list_walker)->sqsum )
+                   / sample_fraction;
+            printf ( "  Date: %s  Estimated %.0f times (95%% CI %.0f - %.0f)"
+                     "  Found %d times\n",
+                     list_walker->dtstr, estimate,
+                     (estimate - spread < list_walker->count)
+                         ? (double)list_walker->count : estimate - spread,
+                     estimate + spread, list_walker->count );
+            list_walker = list_walker->next;
+        }
+        cleanup( SUCCESS, valid_list );
+    }
     printf( "The follwing Valid dates were located in the file:\n" );
     while ( list_walker != NULL )
     {
@@ -300,6 +1271,7 @@ int main( int argc, char **argv)
                  list_walker->dtstr, list_walker->count );
         list_walker = list_walker->next;
     }
+    post_free( &posts );
     cleanup( SUCCESS, valid_list );
     return( 0 ); /* not really needed as the cleanup will exit */
 }